@@ -0,0 +1,148 @@
+#ifndef _BATTERY_MONITOR_H_
+#define _BATTERY_MONITOR_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <nrf.h>
+#include "PollingTimer.h"
+
+// Battery Monitor
+//   一定間隔で SAADC の SAMPLE タスクを起動し、256倍オーバーサンプリングの
+//   変換はBURSTでバックグラウンドに行い、結果はEasyDMAでRAMに書き込まれる。
+//   CPUはタスクの起動と END イベントのポーリングだけで、割り込みもブロッキング待ちも使わない。
+//   mbedのドライバ (UARTE, PWM, BLE) が確保するTIMERとPPIチャンネルとの競合を避けるため、
+//   TIMERやPPIは使わずに起動間隔は IntervalTimer で計る。
+//   (SAADCは analogRead() を呼ばなければ他に使うドライバは無い)
+class BatteryMonitor{
+public:
+    // ain: SAADCのアナログ入力 (A0 = P0.02 = AIN0)
+    void begin(uint32_t ain, uint32_t interval_msec){
+        m_result = 0;
+        m_voltage = 0.0f;
+        m_level = 0;
+        m_isLow = false;
+        m_hasValue = false;
+        m_sampling = false;
+
+        // SAADC: 12bit, 256倍オーバーサンプリング, BURSTで1回のSAMPLEで平均値まで求める
+        NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Disabled;
+        NRF_SAADC->INTENCLR = 0xFFFFFFFF;
+        NRF_SAADC->RESOLUTION = SAADC_RESOLUTION_VAL_12bit;
+        NRF_SAADC->OVERSAMPLE = SAADC_OVERSAMPLE_OVERSAMPLE_Over256x;
+        NRF_SAADC->SAMPLERATE = SAADC_SAMPLERATE_MODE_Task << SAADC_SAMPLERATE_MODE_Pos;
+        for(int i=0; i<8; i++){
+            NRF_SAADC->CH[i].PSELP = SAADC_CH_PSELP_PSELP_NC;
+            NRF_SAADC->CH[i].PSELN = SAADC_CH_PSELN_PSELN_NC;
+        }
+        NRF_SAADC->CH[0].CONFIG =
+            (SAADC_CH_CONFIG_RESP_Bypass   << SAADC_CH_CONFIG_RESP_Pos)   |
+            (SAADC_CH_CONFIG_RESN_Bypass   << SAADC_CH_CONFIG_RESN_Pos)   |
+            (SAADC_CH_CONFIG_GAIN_Gain1_4  << SAADC_CH_CONFIG_GAIN_Pos)   | // 0.6V / (1/4) = 2.4V
+            (SAADC_CH_CONFIG_REFSEL_Internal << SAADC_CH_CONFIG_REFSEL_Pos) |
+            (SAADC_CH_CONFIG_TACQ_40us     << SAADC_CH_CONFIG_TACQ_Pos)   | // 分圧抵抗が高インピーダンスのため
+            (SAADC_CH_CONFIG_MODE_SE       << SAADC_CH_CONFIG_MODE_Pos)   |
+            (SAADC_CH_CONFIG_BURST_Enabled << SAADC_CH_CONFIG_BURST_Pos);
+        NRF_SAADC->CH[0].PSELP = ain;
+        NRF_SAADC->RESULT.PTR = (uint32_t)&m_result;
+        NRF_SAADC->RESULT.MAXCNT = 1;
+        NRF_SAADC->ENABLE = SAADC_ENABLE_ENABLE_Enabled;
+
+        // オフセットのキャリブレーション (起動時に1回だけ)
+        NRF_SAADC->EVENTS_CALIBRATEDONE = 0;
+        NRF_SAADC->TASKS_CALIBRATEOFFSET = 1;
+        while(!NRF_SAADC->EVENTS_CALIBRATEDONE){ }
+        NRF_SAADC->EVENTS_CALIBRATEDONE = 0;
+        while(NRF_SAADC->STATUS == SAADC_STATUS_STATUS_Busy){ }
+
+        // バッファを準備
+        NRF_SAADC->EVENTS_END = 0;
+        NRF_SAADC->EVENTS_STARTED = 0;
+        NRF_SAADC->TASKS_START = 1;
+        while(!NRF_SAADC->EVENTS_STARTED){ }
+        NRF_SAADC->EVENTS_STARTED = 0;
+
+        // 測定間隔のタイマー
+        m_timer.set(interval_msec);
+    }
+
+    // 新しい測定値があれば処理してtrueを返す (メインループから呼ぶ)
+    bool update(){
+        // 測定の開始 (変換はバックグラウンドで行われる)
+        if(!m_sampling && m_timer.elapsed()){
+            m_sampling = true;
+            NRF_SAADC->TASKS_SAMPLE = 1;
+        }
+        if(!NRF_SAADC->EVENTS_END) return false;
+        NRF_SAADC->EVENTS_END = 0;
+        m_sampling = false;
+
+        int16_t raw = m_result;
+        NRF_SAADC->TASKS_START = 1; // 次の測定のためにバッファを準備
+        if(raw < 0) raw = 0; // シングルエンドでも負のオフセットが出ることがある
+        float v = (float)raw * (2.4f / 4096.0f) * 2.0f; // 分圧回路のため2倍する
+
+        // 指数移動平均フィルタ
+        if(m_hasValue){
+            m_voltage += (v - m_voltage) * FILTER_ALPHA;
+        }else{
+            m_voltage = v;
+            m_hasValue = true;
+        }
+
+        // 低バッテリー判定 (ヒステリシス付き)
+        if(m_isLow){
+            if(m_voltage >= LOW_BATTERY + HYSTERESIS) m_isLow = false;
+        }else{
+            if(m_voltage <= LOW_BATTERY) m_isLow = true;
+        }
+
+        // 残量の推定 (変化が小さいときは前回の値を保持)
+        int level = estimateLevel(m_voltage);
+        if(abs(level - (int)m_level) >= LEVEL_HYSTERESIS || level == 0 || level == 100){
+            m_level = (uint8_t)level;
+        }
+        return true;
+    }
+
+    float voltage() const { return m_voltage; } // バッテリー電圧[V] (フィルタ後)
+    uint8_t level() const { return m_level; }   // 推定残量[%]
+    bool isLow() const { return m_isLow; }      // 低バッテリー状態か
+    bool hasValue() const { return m_hasValue; }// 測定値があるか
+
+private:
+    static constexpr float FILTER_ALPHA = 0.1f;  // フィルタ係数
+    static constexpr float LOW_BATTERY  = 2.0f;  // 低バッテリー警告 [V]
+    static constexpr float HYSTERESIS   = 0.1f;  // 低バッテリー解除までの幅 [V]
+    static const int LEVEL_HYSTERESIS   = 2;     // 残量の更新幅 [%]
+
+    // 電圧から残量を推定 (単3電池2本を想定した折れ線近似)
+    static int estimateLevel(float v){
+        static const float table[][2] = {
+            // 電圧[V], 残量[%]
+            {3.0f, 100.0f},
+            {2.6f,  60.0f},
+            {2.3f,  25.0f},
+            {2.0f,   0.0f}
+        };
+        const int n = sizeof(table) / sizeof(table[0]);
+        if(v >= table[0][0]) return 100;
+        if(v <= table[n-1][0]) return 0;
+        for(int i=1; i<n; i++){
+            if(v >= table[i][0]){
+                float t = (v - table[i][0]) / (table[i-1][0] - table[i][0]);
+                return (int)(table[i][1] + t * (table[i-1][1] - table[i][1]) + 0.5f);
+            }
+        }
+        return 0;
+    }
+
+    volatile int16_t m_result; // EasyDMAの書き込み先
+    float m_voltage;
+    uint8_t m_level;
+    bool m_isLow;
+    bool m_hasValue;
+    bool m_sampling; // 変換中か
+    IntervalTimer m_timer;
+};
+
+#endif
@@ -2,9 +2,11 @@
 #include <ArduinoBLE.h>
 #include <Adafruit_NeoPixel.h>
 #include "PollingTimer.h"
+#include "BatteryMonitor.h"
 
 // ピン割り当て
 #define PIN_BATTERY   A0  // バッテリ電圧測定
+#define AIN_BATTERY   SAADC_CH_PSELP_PSELP_AnalogInput0 // (A0 = P0.02 = AIN0)
 #define PIN_BTN_PREV  D1  // Prevボタン
 #define PIN_BTN_NEXT  D2  // Nextボタン
 #define PIN_BTN_START D4  // Start/Endボタン
@@ -24,7 +26,7 @@ enum ButtonInput {
 // ポーリングタイマー
 IntervalTimer buttonTimer;
 IntervalTimer statusTimer;
-IntervalTimer batteryTimer;
+IntervalTimer statsTimer;
 
 // PowerPointの状態
 const uint8_t PPT_OFFLINE  = 0; // 未接続状態
@@ -52,13 +54,35 @@ BLECharacteristic chrCommand ("ba21ce66-9974-4ecd-b2e5-ab6d1497a7f1",
                          BLENotify, 20);
 BLECharacteristic chrResponse("ba21ce66-9974-4ecd-b2e5-ab6d1497a7f2",
                          BLEWrite, sizeof(PptResponse));
+BLEByteCharacteristic chrBattery("ba21ce66-9974-4ecd-b2e5-ab6d1497a7f3",
+                         BLERead | BLENotify); // バッテリー残量[%]
 
 // フルカラーLED
 Adafruit_NeoPixel pixels = Adafruit_NeoPixel(1, PIN_NEOPIXEL, NEO_GRB + NEO_KHZ800);
 const int LED_BRIGHTNESS = 32; // 明るさ(0-255)
+const uint32_t LED_COLOR_TABLE[] = {
+  0xFF0000, // PPT_OFFLINE  赤
+  0xC04800, // PPT_NO_SLIDE 橙
+  0x808000, // PPT_STOPPED  黄
+  0x00FF00, // PPT_RUNNING  緑
+  0x0000FF  // PPT_BLACKOUT 青
+};
+
+// 1にすると従来の方式 (500msごとの analogRead() と毎回の pixels.show()) で動かす
+// 負荷計測の比較用 (バッテリー残量の通知は行わない)
+#define BATTERY_LEGACY 0
 
-// バッテリー電圧の閾値
-const float LOW_BATTERY  = 2.0f; // 低バッテリー警告
+// バッテリー監視
+BatteryMonitor battery;
+const uint32_t BATTERY_INTERVAL = 100; // 測定間隔 [ms]
+
+// 負荷計測用のカウンタ (DWTのサイクルカウンタで計測)
+struct Stats {
+  uint32_t ledShowCount;   // pixels.show() の回数
+  uint32_t ledShowCycles;  // pixels.show() の所要サイクル数 (≒割り込み禁止時間)
+  uint32_t batteryCycles;  // バッテリー処理の所要サイクル数
+};
+Stats stats;
 
 // ボタン入力の取得
 ButtonInput get_button_input()
@@ -77,6 +101,20 @@ ButtonInput get_button_input()
   return ret;
 }
 
+// スカウターにバッテリー残量を送信
+void send_battery_to_scouter()
+{
+  static char tx_buff[8];
+
+  if (!battery.hasValue()) return;
+  sprintf(tx_buff, "%c%%%02X%c",
+          0x02, // STX
+          battery.level() & 0xFF,
+          0x03 // ETX
+        );
+  Serial1.print(tx_buff);
+}
+
 // スカウターに送信
 void send_to_scouter()
 {
@@ -91,48 +129,113 @@ void send_to_scouter()
           0x03 // ETX
         );
   Serial1.print(tx_buff);
+
+  // スカウターが後から起動した場合のためにバッテリー残量も送る
+  send_battery_to_scouter();
+}
+
+// フルカラーLEDに書き込み (表示が変わるときだけ, 従来の方式では毎回)
+void show_led(uint32_t color)
+{
+  static uint32_t shownColor = 0xFFFFFFFF; // 未表示
+
+#if !BATTERY_LEGACY
+  if (color == shownColor) return;
+#endif
+  shownColor = color;
+
+  uint32_t start = DWT->CYCCNT;
+  pixels.setPixelColor(0, color);
+  pixels.show();
+  stats.ledShowCycles += DWT->CYCCNT - start;
+  stats.ledShowCount++;
 }
 
 // フルカラーLEDの制御
 void set_led_color()
 {
-  const uint32_t colorTable[] = {
-    0xFF0000, // PPT_OFFLINE  赤
-    0xC04800, // PPT_NO_SLIDE 橙
-    0x808000, // PPT_STOPPED  黄
-    0x00FF00, // PPT_RUNNING  緑
-    0x0000FF  // PPT_BLACKOUT 青
-  };
-
-  pixels.setPixelColor(0, colorTable[ppt.status]);
-  pixels.show();
+#if BATTERY_LEGACY
+  // 従来の方式では点滅は update_battery() で行う
+  show_led(LED_COLOR_TABLE[ppt.status]);
+#else
+  // 低バッテリー警告 (LEDを500ms周期で点滅させる)
+  bool blink = battery.isLow() && ((millis() / 500) % 2 == 1);
+  show_led(blink ? 0x000000 : LED_COLOR_TABLE[ppt.status]);
+#endif
 }
 
-// バッテリー電圧の取得
-void get_battery_voltage()
+#if BATTERY_LEGACY
+// 従来の方式のバッテリー電圧の取得 (負荷計測の比較用)
+void update_battery()
 {
+  const float LOW_BATTERY = 2.0f; // 低バッテリー警告
+  static IntervalTimer legacyTimer;
+  static bool timerStarted = false;
   static bool blink = false;
 
+  if (!timerStarted) {
+    legacyTimer.set(500);
+    timerStarted = true;
+  }
+  if (!legacyTimer.elapsed()) return;
+
+  uint32_t start = DWT->CYCCNT;
   int adc = analogRead(PIN_BATTERY);
   float v = (float)adc * (2.4f / 1023.0f) * 2.0f; // 分圧回路のため2倍する
 
-  //Serial.print("Battery Voltage: ");
-  //Serial.println(v);
-
   // 低バッテリー警告 (LEDを点滅させる)
   if (v <= LOW_BATTERY) {
     Serial.println("Low Battery Warning!");
-    if (blink) {
-      set_led_color();
-    } else {
-      pixels.setPixelColor(0, 0x000000);
-      pixels.show();
-    }
+    show_led(blink ? LED_COLOR_TABLE[ppt.status] : 0x000000);
     blink = !blink;
-  }else{
+  } else {
     blink = false;
+    show_led(LED_COLOR_TABLE[ppt.status]);
+  }
+  stats.batteryCycles += DWT->CYCCNT - start;
+}
+#else
+// バッテリーの監視 (新しい測定値があれば処理)
+void update_battery()
+{
+  uint32_t start = DWT->CYCCNT;
+  if (battery.update()) {
+    // 残量が変わったらセントラルとスカウターに通知
+    if (battery.level() != chrBattery.value()) {
+      chrBattery.writeValue(battery.level());
+      send_battery_to_scouter();
+    }
+    // 低バッテリー警告
+    static bool wasLow = false;
+    if (battery.isLow() && !wasLow) {
+      Serial.println("Low Battery Warning!");
+    }
+    wasLow = battery.isLow();
+    // 低バッテリー時の点滅
     set_led_color();
   }
+  stats.batteryCycles += DWT->CYCCNT - start;
+}
+#endif
+
+// 負荷計測の結果を表示
+void print_stats()
+{
+  const uint32_t CYCLES_PER_US = SystemCoreClock / 1000000;
+
+  Serial.print("Battery: ");
+  Serial.print(battery.voltage());
+  Serial.print("V ");
+  Serial.print(battery.level());
+  Serial.println("%");
+  Serial.print("Stats: LED show ");
+  Serial.print(stats.ledShowCount);
+  Serial.print(" times, ");
+  Serial.print(stats.ledShowCycles / CYCLES_PER_US);
+  Serial.print("us / battery ");
+  Serial.print(stats.batteryCycles / CYCLES_PER_US);
+  Serial.println("us");
+  memset(&stats, 0, sizeof(stats));
 }
 
 // 初期化
@@ -155,10 +258,20 @@ void setup()
   pinMode(PIN_LASER_EN, OUTPUT);
   digitalWrite(PIN_LASER_EN, LOW); // レーザー出力無効
 
-  // バッテリ電圧測定ピンの設定
+  // 負荷計測用のサイクルカウンタを有効化
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+#if BATTERY_LEGACY
+  // バッテリ電圧測定ピンの設定 (従来の方式)
   pinMode(PIN_BATTERY, INPUT);
   analogReference(AR_INTERNAL2V4); // VREF = 2.4V
   analogReadResolution(10);        // 10bit A/D
+#else
+  // バッテリー監視の開始 (以降はバックグラウンドで測定)
+  battery.begin(AIN_BATTERY, BATTERY_INTERVAL);
+#endif
 
   // BLEの初期化
   if (!BLE.begin()) {
@@ -177,6 +290,8 @@ void setup()
   BLE.setAdvertisedService(svcPptCtrl);
   svcPptCtrl.addCharacteristic(chrCommand);   // コマンド送信用
   svcPptCtrl.addCharacteristic(chrResponse);  // 応答受信用
+  svcPptCtrl.addCharacteristic(chrBattery);   // バッテリー残量
+  chrBattery.writeValue(0);
   BLE.addService(svcPptCtrl);
   BLE.advertise();
 
@@ -200,7 +315,7 @@ void loop()
     // ポーリングタイマーの設定
     buttonTimer.set(10);
     statusTimer.set(1000);
-    batteryTimer.set(500);
+    statsTimer.set(10000);
     bool toGetStatus = true;
 
     // レーザー出力有効
@@ -253,9 +368,11 @@ void loop()
 
         toGetStatus = false; // 状態取得コマンドを送るフラグをクリア
       }
-      // バッテリー電圧の取得
-      if (batteryTimer.elapsed()) {
-        get_battery_voltage();
+      // バッテリーの監視
+      update_battery();
+      // 負荷計測の結果を表示
+      if (statsTimer.elapsed()) {
+        print_stats();
       }
     } // while (central.connected()) ココマデ
 
@@ -274,11 +391,13 @@ void loop()
 
   // スカウターに送信
   send_to_scouter();
+
   // フルカラーLEDの制御
   set_led_color();
 
-  // バッテリー電圧の取得
-  get_battery_voltage();
-
-  delay(500);
+  // バッテリーの監視
+  for (int i = 0; i < 500 / BATTERY_INTERVAL; i++) {
+    delay(BATTERY_INTERVAL);
+    update_battery();
+  }
 }
@@ -0,0 +1,98 @@
+#ifndef _FONT_SUBSET_H_
+#define _FONT_SUBSET_H_
+
+#include <stdint.h>
+
+// サブセットフォントのデータと索引 (Arduinoに依存しないのでホストでもビルドできる)
+//   データは tools/gen_font_subset.py がビルド前に font_subset_data.h に生成する
+namespace font_subset {
+
+// グリフ (1文字8バイト, 先頭位置は24bitで詰める)
+struct Glyph {
+  uint32_t offset : 24; // BITMAP中の先頭位置
+  uint32_t width  : 8;  // 幅
+  uint8_t height;       // 高さ
+  int8_t x;             // X方向オフセット
+  int8_t y;             // ベースラインからの下端の高さ
+  uint8_t advance;      // 送り幅
+};
+static_assert(sizeof(Glyph) == 8, "Glyph must be packed into 8 bytes");
+
+} // namespace font_subset
+
+#include "font_subset_data.h"
+
+namespace font_subset {
+
+// サブセットに無い文字の代わりに表示する文字 (〓)
+constexpr uint16_t FALLBACK_CODE = 0x3013;
+
+// 文字コードからグリフ番号を得る (無ければ-1)
+//   上位8bitでページを引き、ページ内は256bitのビットマップと累積数で数える
+constexpr int find(uint16_t code)
+{
+  const uint8_t page = PAGE_INDEX[code >> 8];
+  if (page == 0xFF) return -1;
+  const int word = (code & 0xFF) >> 5;
+  const uint32_t bit = 1UL << (code & 31);
+  const uint32_t bits = PAGE_BITS[page][word];
+  if (!(bits & bit)) return -1;
+  return PAGE_RANK[page][word] + __builtin_popcount(bits & (bit - 1));
+}
+
+// グリフを得る (無ければnullptr)
+constexpr const Glyph* getGlyph(uint16_t code)
+{
+  const int index = find(code);
+  return (index < 0) ? nullptr : &GLYPHS[index];
+}
+
+// 表示するグリフを得る (サブセットに無いASCII以外の文字は代わりの文字)
+constexpr const Glyph* getGlyphOrFallback(uint16_t code)
+{
+  const Glyph* glyph = getGlyph(code);
+  return (glyph == nullptr && code >= 0x80) ? getGlyph(FALLBACK_CODE) : glyph;
+}
+
+// 1行分のバイト数
+constexpr int rowBytes(const Glyph& glyph)
+{
+  return (glyph.width + 7) / 8;
+}
+
+// グリフの描画
+//   1行ごとに連続するドットをまとめて fill(x, y, 幅) を呼ぶ (SubsetFont とベンチマークで共通)
+//   x, y は文字の描画位置 (行の左上) からの相対座標
+template <typename Fill>
+inline void drawGlyph(const Glyph& glyph, Fill fill)
+{
+  const uint8_t* row = &BITMAP[glyph.offset];
+  const int bytes = rowBytes(glyph);
+  const int top = ASCENT - (glyph.height + glyph.y);
+  for (int j = 0; j < glyph.height; j++, row += bytes) {
+    int i = 0;
+    while (i < glyph.width) {
+      // 次のドットを探す (1バイトずつ, 行末の詰め物のビットは0)
+      const unsigned dots = row[i >> 3] & (0xFFU >> (i & 7));
+      if (dots == 0) { i = (i | 7) + 1; continue; }
+      i = (i & ~7) + __builtin_clz(dots) - 24;
+      // ドットが途切れる位置を探す
+      const int start = i;
+      for (;;) {
+        const unsigned gaps = ~row[i >> 3] & (0xFFU >> (i & 7));
+        if (gaps != 0) { i = (i & ~7) + __builtin_clz(gaps) - 24; break; }
+        i = (i | 7) + 1;
+        if (i >= glyph.width) break;
+      }
+      fill(glyph.x + start, top + j, i - start);
+    }
+  }
+}
+
+// 索引が生成時と一致することをコンパイル時に確認
+static_assert(find(CHECK_CODE) == CHECK_INDEX, "font subset index is broken");
+static_assert(find(FALLBACK_CODE) >= 0, "fallback glyph is missing from the font subset");
+
+} // namespace font_subset
+
+#endif
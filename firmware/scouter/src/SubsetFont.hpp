@@ -0,0 +1,75 @@
+#ifndef _SUBSET_FONT_HPP_
+#define _SUBSET_FONT_HPP_
+
+#include <LovyanGFX.hpp>
+#include "FontSubset.h"
+
+// サブセットフォント (LovyanGFXのフォントとして使う)
+//   lgfxJapanGothic_24 から必要な文字だけを取り出したもの
+//   サブセットに無い文字 (第2水準漢字など) は 〓 で表示して、欠けていることが分かるようにする
+class SubsetFont : public lgfx::IFont
+{
+public:
+  constexpr SubsetFont() {}
+
+  // 行の高さとベースラインは U8g2font と同じく
+  // max_char_height と max_char_height + y_offset (= ASCENT) から決める
+  void getDefaultMetric(lgfx::FontMetrics *metrics) const override
+  {
+    metrics->width     = font_subset::MAX_WIDTH;
+    metrics->x_advance = font_subset::MAX_WIDTH;
+    metrics->x_offset  = 0;
+    metrics->height    = font_subset::HEIGHT;
+    metrics->y_advance = font_subset::HEIGHT;
+    metrics->y_offset  = 0;
+    metrics->baseline  = font_subset::ASCENT;
+  }
+
+  bool updateFontMetric(lgfx::FontMetrics *metrics, uint16_t uniCode) const override
+  {
+    const font_subset::Glyph* glyph = font_subset::getGlyphOrFallback(uniCode);
+    if (glyph == nullptr) return false;
+    metrics->width     = glyph->width;
+    metrics->x_advance = glyph->advance;
+    metrics->x_offset  = glyph->x;
+    return true;
+  }
+
+  size_t drawChar(lgfx::LGFXBase* gfx, int32_t x, int32_t y, uint16_t c,
+                  const lgfx::TextStyle* style, lgfx::FontMetrics* metrics, int32_t& filled_x) const override
+  {
+    const font_subset::Glyph* glyph = font_subset::getGlyphOrFallback(c);
+    if (glyph == nullptr) return 0;
+
+    const float sx = style->size_x;
+    const float sy = style->size_y;
+    const int32_t advance = (int32_t)(glyph->advance * sx);
+
+    gfx->startWrite();
+
+    // 背景の塗りつぶし (文字色と背景色が異なる場合)
+    if (style->back_rgb888 != style->fore_rgb888) {
+      int32_t left = (filled_x > x) ? filled_x : x;
+      if (x + advance > left) {
+        gfx->setColor(style->back_rgb888);
+        gfx->writeFillRect(left, y, x + advance - left, (int32_t)(font_subset::HEIGHT * sy));
+        filled_x = x + advance;
+      }
+    }
+
+    // グリフの描画 (1行ごとに連続するドットをまとめて塗る)
+    gfx->setColor(style->fore_rgb888);
+    font_subset::drawGlyph(*glyph, [&](int gx, int gy, int w) {
+      int32_t px0 = x + (int32_t)(gx * sx);
+      int32_t px1 = x + (int32_t)((gx + w) * sx);
+      int32_t py0 = y + (int32_t)(gy * sy);
+      int32_t py1 = y + (int32_t)((gy + 1) * sy);
+      gfx->writeFillRect(px0, py0, px1 - px0, py1 - py0);
+    });
+
+    gfx->endWrite();
+    return advance;
+  }
+};
+
+#endif
@@ -76,17 +76,32 @@ TFT_eSprite sprite_t = TFT_eSprite(&tft); // 上段スプライト(経過時間
 TFT_eSprite sprite_b = TFT_eSprite(&tft); // 本文スプライト
 TFT_eSprite sprite_f = TFT_eSprite(&tft); // 下段スプライト
 
-// フォントサイズ
-const int FONT_SIZE = 24;
+// フォント (lgfxJapanGothic_24)
+//   build_flags に -D SCOUTER_SUBSET_FONT を付けるとビルド時に生成したサブセットで表示する (試験中)
+#ifdef SCOUTER_SUBSET_FONT
+#include "SubsetFont.hpp"
+const SubsetFont subset_font;
+const lgfx::v1::IFont *const SCOUTER_FONT = &subset_font;
+#else
+const lgfx::v1::IFont *const SCOUTER_FONT = &fonts::lgfxJapanGothic_24;
+#endif
+const int FONT_SIZE = 24; // フォントサイズ
 
 // シリアル受信バッファと状態
 enum {
   RX_IDLE = 0, // 受信待ち
   RX_RECV,     // 受信中
 };
-char rx_buff[512];
-int rx_index = 0;
-int rx_state = RX_IDLE;
+struct RxParser {
+  char buff[512];
+  int index = 0;
+  int state = RX_IDLE;
+};
+RxParser rx_usb;  // USB CDC (PCから直接)
+RxParser rx_uart; // UART1 (プレゼンター経由)
+
+// USB CDCからフレームを受信したか (受信したらUART1より優先)
+bool usb_active = false;
 
 // PowerPointの状態
 const uint8_t PPT_OFFLINE  = 0; // 未接続状態
@@ -121,6 +136,10 @@ struct PptResponse {
 };
 PptResponse ppt;
 
+// プレゼンターのバッテリー残量[%] (-1は不明)
+int battery_level = -1;
+const int LOW_BATTERY_LEVEL = 10; // 残量表示を赤にする閾値[%]
+
 // 経過時間表示用
 bool is_running = false;    // スライドショー実行中か
 uint32_t elapsed_time = 0;  // 経過時間 [秒]
@@ -160,7 +179,7 @@ void show_time()
   int sec = elapsed_time % 60;
 
   // フォント
-  const lgfx::v1::IFont *font = &fonts::lgfxJapanGothic_24;
+  const lgfx::v1::IFont *font = SCOUTER_FONT;
 
   // 経過時間の表示更新
   sprite_t.setFont(font);
@@ -172,11 +191,34 @@ void show_time()
   sprite_t.pushSprite(tft.width() / 2, 0);
 }
 
+// 下段の表示 (ページ番号とバッテリー残量)
+void show_footer()
+{
+  // フォント
+  const lgfx::v1::IFont *font = SCOUTER_FONT;
+
+  sprite_f.setFont(font);
+  sprite_f.setTextColor(PPT_STATUS_COLOR[ppt.status], TFT_BLACK);
+  sprite_f.fillScreen(TFT_BLACK);
+  sprite_f.setCursor(sprite_f.width() / 2 - FONT_SIZE * 3, 0);
+  sprite_f.setTextWrap(false);
+  sprite_f.printf("%3d / %d", ppt.currentPage, ppt.totalPages);
+
+  // バッテリー残量 (右寄せ)
+  if(battery_level >= 0){
+    uint16_t color = (battery_level <= LOW_BATTERY_LEVEL) ? TFT_RED : TFT_DARKGREY;
+    sprite_f.setTextColor(color, TFT_BLACK);
+    sprite_f.setCursor(sprite_f.width() - FONT_SIZE * 2, 0);
+    sprite_f.printf("%3d%%", battery_level);
+  }
+  sprite_f.pushSprite(FONT_SIZE, tft.height() - FONT_SIZE);
+}
+
 // 画面表示
 void show_status()
 {
   // フォント
-  const lgfx::v1::IFont *font = &fonts::lgfxJapanGothic_24;
+  const lgfx::v1::IFont *font = SCOUTER_FONT;
 
   // 上段の表示更新 (状態表示)
   sprite_h.setFont(font);
@@ -200,23 +242,31 @@ void show_status()
   sprite_b.pushSprite(0, FONT_SIZE);
 
   // 下段の表示更新
-  sprite_f.setFont(font);
-  sprite_f.setTextColor(PPT_STATUS_COLOR[ppt.status], TFT_BLACK);
-  sprite_f.fillScreen(TFT_BLACK);
-  sprite_f.setCursor(sprite_f.width() / 2 - FONT_SIZE * 3, 0);
-  sprite_f.setTextWrap(false);
-  sprite_f.printf("%3d / %d", ppt.currentPage, ppt.totalPages);
-  sprite_f.pushSprite(FONT_SIZE, tft.height() - FONT_SIZE);
+  show_footer();
 }
 
-// プレゼンターから受信したデータの処理
+// 受信したデータの処理
 void on_recv_data(const char* data)
 {
   Serial.print("RX:");
-  Serial.println(rx_buff);
+  Serial.println(data);
+
+  // バッテリー残量のメッセージ ('%' + 2桁)
+  if(data[0] == '%'){
+    unsigned int level;
+    if(sscanf(&data[1], "%2x", &level) != 1 || level > 100){
+      Serial.println("ERROR: battery");
+      return;
+    }
+    if((int)level != battery_level){
+      battery_level = level;
+      show_footer();
+    }
+    return;
+  }
 
   // メッセージの解釈
-  int result = sscanf(rx_buff,
+  int result = sscanf(data,
     "%1hhx%4hhx%4hhx",
     &ppt.status,       // [0]
     &ppt.currentPage,  // [1]-[4]
@@ -226,7 +276,7 @@ void on_recv_data(const char* data)
     Serial.println("ERROR: sscanf");
     return;
   }
-  memcpy(ppt.note, &rx_buff[9], sizeof(ppt.note)-1);
+  strncpy(ppt.note, &data[9], sizeof(ppt.note)-1);
   ppt.note[sizeof(ppt.note)-1] = '\0'; // 念のためNULL終端
 
   // 経過時間のリスタート/リセット
@@ -247,50 +297,63 @@ void on_recv_data(const char* data)
   show_status();
 }
 
-// プレゼンターからのシリアル受信処理
-void serial_com()
+// シリアル受信処理 (フレームを受信したらtrueを返す)
+//   enabled が false のときは受信したフレームを読み捨てる
+bool serial_com(Stream& port, RxParser& rx, bool enabled)
 {
-  while(Serial1.available() > 0){
-    char c = Serial1.read();
-    switch(rx_state){
+  bool received = false;
+  while(port.available() > 0){
+    char c = port.read();
+    switch(rx.state){
       // 受信待ち
       case RX_IDLE:
         if(c == 0x02){ // STX
-          rx_state = RX_RECV;
-          rx_index = 0;
+          rx.state = RX_RECV;
+          rx.index = 0;
         }
         break;
       // 受信中
       case RX_RECV:
         if(c == 0x02){ // STX (途中でSTXが来たら最初から)
-          rx_index = 0;
+          rx.index = 0;
         }
         else if(c == 0x03){ // ETX
-          rx_state = RX_IDLE;
+          rx.state = RX_IDLE;
+          received = true;
           // 受信したデータの処理
-          rx_buff[rx_index] = '\0';
-          on_recv_data(rx_buff);
+          rx.buff[rx.index] = '\0';
+          if(enabled) on_recv_data(rx.buff);
         }
         else{
-          rx_buff[rx_index] = c;
-          rx_index++;
-          if(rx_index >= sizeof(rx_buff)-1){
-            rx_index = sizeof(rx_buff)-1;
+          rx.buff[rx.index] = c;
+          rx.index++;
+          if(rx.index >= sizeof(rx.buff)-1){
+            rx.index = sizeof(rx.buff)-1;
           }
         }
         break;
       default:
-        rx_state = RX_IDLE;
+        rx.state = RX_IDLE;
         break;
     }
   }
+  return received;
 }
 
 // メインループ
 void loop()
 {
-  // シリアル受信処理
-  serial_com();
+  // PCがUSB CDCのポートを閉じたらプレゼンター経由に戻す
+  if(usb_active && !Serial){
+    usb_active = false;
+  }
+
+  // USB CDCからの受信処理 (PCから直接、優先)
+  if(serial_com(Serial, rx_usb, true)){
+    usb_active = true;
+  }
+  // プレゼンターからの受信処理 (USB CDCから受信中は読み捨て)
+  serial_com(Serial1, rx_uart, !usb_active);
 
   // 経過時間の更新
   if(is_running && onesec_timer.elapsed()){
@@ -0,0 +1,210 @@
+// サブセットフォントと標準フォント(U8g2形式)の比較ベンチマーク (ホスト用)
+//   python tools/gen_font_subset.py --lovyan <LovyanGFXのパス> --bench
+// でビルドして実行する。グリフ検索と描画の時間、描画の塗りつぶし回数を比べる。
+//   サブセット側は SubsetFont::drawChar と同じ font_subset::drawGlyph() を使う。
+//   標準フォント側は U8g2font::drawChar と同じく、RLEの1の並びを行の端で区切って塗る
+//   (LovyanGFX のコードそのものではなく同じ手順の再実装)。
+//   どちらも同じ fill() で1ドット1バイトのバッファに描くので、実機での差は
+//   主に writeFillRect() の呼び出し回数 (fills/glyph) に現れる。
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "FontSubset.h"
+#include "stock_font_data.h"
+
+// 描画先 (1bpp, 1ドット1バイト)
+static const int FB_WIDTH  = 64;
+static const int FB_HEIGHT = 64;
+static uint8_t fb[FB_HEIGHT][FB_WIDTH];
+static long fill_count = 0;
+
+// 横一列の塗りつぶし (writeFillRect の代わり)
+static void fill(int x, int y, int w)
+{
+  memset(&fb[y][x], 1, w);
+  fill_count++;
+}
+
+//////////////////////////////////////////////////////
+//  標準フォント (U8g2形式, U8g2と同じ手順で検索・展開)
+//////////////////////////////////////////////////////
+
+static uint16_t get_word(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+
+// グリフの検索
+static const uint8_t* stock_find(uint16_t code)
+{
+  const uint8_t* font = STOCK_FONT + 23;
+  if (code <= 0xFF) {
+    for (;;) {
+      if (font[1] == 0) return nullptr;
+      if (font[0] == code) return font + 2;
+      font += font[1];
+    }
+  }
+  font += get_word(STOCK_FONT + 21);
+  const uint8_t* table = font;
+  uint16_t e;
+  do {
+    font += get_word(table);
+    e = get_word(table + 2);
+    table += 4;
+  } while (e < code);
+  for (;;) {
+    e = get_word(font);
+    if (e == 0) return nullptr;
+    if (e == code) return font + 3;
+    font += font[2];
+  }
+}
+
+// ビット列の読み出し
+struct BitReader {
+  const uint8_t* p;
+  uint8_t bit;
+  unsigned get(uint8_t cnt) {
+    unsigned val = *p >> bit;
+    unsigned next = bit + cnt;
+    if (next >= 8) { p++; val |= *p << (8 - bit); next -= 8; }
+    bit = next;
+    return val & ((1U << cnt) - 1);
+  }
+  int getSigned(uint8_t cnt) { return (int)get(cnt) - (1 << (cnt - 1)); }
+};
+
+// グリフの展開 (1の並びごとに fill() を呼ぶ, 行の端で区切る)
+static int stock_draw(const uint8_t* glyph, int ox, int oy)
+{
+  const uint8_t* h = STOCK_FONT;
+  BitReader r = { glyph, 0 };
+  int w  = r.get(h[4]);
+  int gh = r.get(h[5]);
+  int x  = r.getSigned(h[6]);
+  int y  = r.getSigned(h[7]);
+  int d  = r.getSigned(h[8]);
+  if (w > 0) {
+    int px = 0, py = 0;
+    int top = oy + (h[10] + (int8_t)h[12]) - (gh + y);
+    for (;;) {
+      unsigned a = r.get(h[2]);
+      unsigned b = r.get(h[3]);
+      do {
+        // 0の並びは読み飛ばす
+        px += a;
+        while (px >= w) { px -= w; py++; }
+        // 1の並びを塗る
+        unsigned len = b;
+        while (len > 0) {
+          unsigned n = (len < (unsigned)(w - px)) ? len : (unsigned)(w - px);
+          fill(ox + x + px, top + py, n);
+          px += n;
+          len -= n;
+          if (px >= w) { px = 0; py++; }
+        }
+      } while (r.get(1) != 0);
+      if (py >= gh) break;
+    }
+  }
+  return d;
+}
+
+//////////////////////////////////////////////////////
+//  サブセットフォント
+//////////////////////////////////////////////////////
+
+// SubsetFont::drawChar と同じ描画
+static int subset_draw(const font_subset::Glyph* glyph, int ox, int oy)
+{
+  font_subset::drawGlyph(*glyph, [&](int x, int y, int w) { fill(ox + x, oy + y, w); });
+  return glyph->advance;
+}
+
+//////////////////////////////////////////////////////
+//  計測
+//////////////////////////////////////////////////////
+
+template<typename F>
+static double measure_ns(int count, F func)
+{
+  auto start = std::chrono::steady_clock::now();
+  func();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / count;
+}
+
+int main()
+{
+  // サブセットに含まれる全文字で計測
+  std::vector<uint16_t> codes;
+  for (uint32_t c = 0; c <= 0xFFFF; c++) {
+    if (font_subset::find(c) >= 0) codes.push_back(c);
+  }
+  const int REPEAT = 20;
+  const int count = (int)codes.size() * REPEAT;
+  volatile uintptr_t sink = 0;
+
+  // グリフの検索
+  double stock_find_ns = measure_ns(count, [&]{
+    for (int n = 0; n < REPEAT; n++) for (uint16_t c : codes) sink += (uintptr_t)stock_find(c);
+  });
+  double subset_find_ns = measure_ns(count, [&]{
+    for (int n = 0; n < REPEAT; n++) for (uint16_t c : codes) sink += (uintptr_t)font_subset::getGlyph(c);
+  });
+
+  // 検索と描画 (塗りつぶし回数も数える)
+  fill_count = 0;
+  double stock_draw_ns = measure_ns(count, [&]{
+    for (int n = 0; n < REPEAT; n++) for (uint16_t c : codes) {
+      const uint8_t* g = stock_find(c);
+      if (g) sink += stock_draw(g, 16, 16);
+    }
+  });
+  const double stock_fills = (double)fill_count / count;
+  fill_count = 0;
+  double subset_draw_ns = measure_ns(count, [&]{
+    for (int n = 0; n < REPEAT; n++) for (uint16_t c : codes) {
+      const font_subset::Glyph* g = font_subset::getGlyph(c);
+      if (g) sink += subset_draw(g, 16, 16);
+    }
+  });
+
+  const double subset_fills = (double)fill_count / count;
+
+  // 展開結果が一致するか確認
+  int mismatch = 0;
+  for (uint16_t c : codes) {
+    static uint8_t expected[FB_HEIGHT][FB_WIDTH];
+    memset(fb, 0, sizeof(fb));
+    const uint8_t* g = stock_find(c);
+    if (g) stock_draw(g, 16, 16);
+    memcpy(expected, fb, sizeof(fb));
+    memset(fb, 0, sizeof(fb));
+    subset_draw(font_subset::getGlyph(c), 16, 16);
+    if (memcmp(expected, fb, sizeof(fb)) != 0) mismatch++;
+  }
+
+  const size_t subset_index = sizeof(font_subset::PAGE_INDEX) + sizeof(font_subset::PAGE_BITS)
+    + sizeof(font_subset::PAGE_RANK);
+  const size_t subset_bytes = sizeof(font_subset::GLYPHS) + sizeof(font_subset::BITMAP) + subset_index;
+
+  // 同じ文字だけを標準フォントの形式 (RLE) で持った場合の大きさ
+  size_t stock_selected = 0;
+  for (uint16_t c : codes) {
+    const uint8_t* g = stock_find(c);
+    if (g) stock_selected += g[-1]; // グリフの直前のバイトがグリフ全体の大きさ
+  }
+
+  printf("glyphs      : %d\n", (int)codes.size());
+  printf("flash size  : stock %zu bytes (whole font), %zu bytes (selected glyphs, RLE)\n",
+         sizeof(STOCK_FONT), stock_selected);
+  printf("              subset %zu bytes (glyphs %zu + bitmap %zu + index %zu)\n", subset_bytes,
+         sizeof(font_subset::GLYPHS), sizeof(font_subset::BITMAP), subset_index);
+  printf("lookup      : stock %8.1f ns, subset %8.1f ns\n", stock_find_ns, subset_find_ns);
+  printf("lookup+draw : stock %8.1f ns, subset %8.1f ns (host)\n", stock_draw_ns, subset_draw_ns);
+  printf("fills/glyph : stock %8.1f,    subset %8.1f\n", stock_fills, subset_fills);
+  printf("mismatch    : %d\n", mismatch);
+  return mismatch == 0 ? 0 : 1;
+}
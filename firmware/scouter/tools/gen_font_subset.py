@@ -0,0 +1,476 @@
+# スカウター用のサブセットフォントを生成する
+#
+# LovyanGFX の lgfxJapanGothic_24 (U8g2形式) から指定した文字だけを取り出し、
+# src/font_subset_data.h にフラッシュ常駐のテーブルとして書き出す。
+# 文字コードからグリフ番号への索引は、上位8bitのページ表と
+# ページごとの256bitビットマップ (+累積数) による直接参照で引く (FontSubset.h)。
+#
+# サブセットに無い文字は 〓 で表示するので、〓 は常にサブセットに入れる。
+#
+# PlatformIOのビルド前スクリプトとして実行される (platformio.ini の extra_scripts)
+#   build_flags に -D SCOUTER_SUBSET_FONT があるときだけ生成する
+#   custom_font_charset = jis1       ; jis1 = JIS第1水準+非漢字+ASCII, ascii = ASCIIのみ
+#   custom_font_deck    = deck.pptx  ; このファイルに含まれる文字を追加 (.pptx またはテキスト)
+#   custom_font_extra   = ★☆        ; 追加する文字
+#
+# 単体でも実行できる (--bench で標準フォントとの比較ベンチマークを実行)
+#   python tools/gen_font_subset.py --lovyan <LovyanGFXのパス> [--deck deck.pptx] [--bench]
+
+import os
+import re
+import sys
+import glob
+import html
+import zipfile
+import hashlib
+import bisect
+import argparse
+import subprocess
+
+# 元にするフォント
+FONT_SYMBOL = "lgfx_font_japan_gothic_24"
+
+# 生成するファイル (プロジェクトのディレクトリからの相対パス)
+OUTPUT_PATH = os.path.join("src", "font_subset_data.h")
+BENCH_DIR   = os.path.join(".pio", "font_bench")
+
+# 生成処理を変えたら上げる (キャッシュの無効化)
+GENERATOR_VERSION = 3
+
+# サブセットに無い文字の代わりに表示する文字 (FontSubset.h の FALLBACK_CODE)
+FALLBACK_CHAR = "\u3013" # 〓
+
+#######################################################
+#  文字集合
+#######################################################
+
+# JIS X 0208 の区の文字
+#   EUC-JP と CP932 で対応するUnicodeが異なる文字があるので両方を入れる
+#   (例: 1区33点 〜 U+301C / ～ U+FF5E, 1区61点 − U+2212 / － U+FF0D)
+#   Windows の PowerPoint のノートは CP932 側の文字になる
+def jis_rows(rows):
+    chars = set()
+    for ku in rows:
+        for ten in range(1, 95):
+            for code, encoding in ((euc_bytes(ku, ten), "euc_jp"), (sjis_bytes(ku, ten), "cp932")):
+                try:
+                    chars.add(code.decode(encoding))
+                except UnicodeDecodeError:
+                    pass # 未定義の点
+    return chars
+
+# 区点 → EUC-JP
+def euc_bytes(ku, ten):
+    return bytes([0xA0 + ku, 0xA0 + ten])
+
+# 区点 → Shift_JIS
+def sjis_bytes(ku, ten):
+    s1 = (ku + 1) // 2 + (0x80 if ku <= 62 else 0xC0)
+    if ku % 2 == 1:
+        s2 = ten + (0x3F if ten <= 63 else 0x40)
+    else:
+        s2 = ten + 0x9E
+    return bytes([s1, s2])
+
+# 文字集合の名前から文字の集合を得る
+def base_charset(name):
+    ascii_chars = set(chr(c) for c in range(0x20, 0x7F))
+    if name == "ascii":
+        return ascii_chars
+    if name == "jis1":
+        # 1-8区: 非漢字, 16-47区: 第1水準漢字
+        return ascii_chars | jis_rows(range(1, 9)) | jis_rows(range(16, 48))
+    raise ValueError(f"unknown charset: {name}")
+
+# スライド資料に含まれる文字
+def deck_chars(path):
+    if path.lower().endswith(".pptx"):
+        chars = set()
+        with zipfile.ZipFile(path) as z:
+            for name in z.namelist():
+                # スライド本文とノート
+                if re.match(r"ppt/(slides|notesSlides)/[^/]+\.xml$", name):
+                    xml = z.read(name).decode("utf-8")
+                    for text in re.findall(r"<a:t>(.*?)</a:t>", xml, re.S):
+                        chars |= set(html.unescape(text))
+        return chars
+    with open(path, encoding="utf-8") as f:
+        return set(f.read())
+
+#######################################################
+#  U8g2形式フォントの読み込み
+#######################################################
+
+# Cソース中の配列 (数値の並び または 文字列リテラル) をバイト列として取り出す
+def parse_c_array(text, symbol):
+    m = re.search(r"\b" + symbol + r"\s*\[[^\]]*\][^=;]*=\s*", text)
+    if m is None:
+        return None
+    pos = m.end()
+    if text[pos] == "{":
+        end = text.index("}", pos)
+        body = re.sub(r"/\*.*?\*/|//[^\n]*", "", text[pos + 1:end], flags=re.S)
+        return bytes(int(v, 0) for v in body.replace("\n", " ").split(",") if v.strip())
+    # 文字列リテラルの連結
+    data = bytearray()
+    literal = re.compile(r'\s*"((?:[^"\\]|\\.)*)"')
+    m = literal.match(text, pos)
+    while m is not None:
+        data += unescape_c_string(m.group(1))
+        m = literal.match(text, m.end())
+    return bytes(data)
+
+# C文字列リテラルのエスケープを解除
+def unescape_c_string(s):
+    out = bytearray()
+    i = 0
+    simple = {"n": 10, "t": 9, "r": 13, "0": 0, "\\": 92, '"': 34, "'": 39,
+              "a": 7, "b": 8, "f": 12, "v": 11, "?": 63}
+    while i < len(s):
+        c = s[i]
+        if c != "\\":
+            out += c.encode("utf-8")
+            i += 1
+            continue
+        i += 1
+        c = s[i]
+        if c in "01234567":
+            m = re.match(r"[0-7]{1,3}", s[i:])
+            out.append(int(m.group(0), 8) & 0xFF)
+            i += len(m.group(0))
+        elif c == "x":
+            m = re.match(r"[0-9a-fA-F]+", s[i + 1:])
+            out.append(int(m.group(0), 16) & 0xFF)
+            i += 1 + len(m.group(0))
+        else:
+            out.append(simple[c])
+            i += 1
+    return out
+
+# フォントのソースファイルを探す
+def find_font_source(lovyan_dir):
+    for ext in ("*.c", "*.h", "*.cpp", "*.hpp"):
+        for path in glob.glob(os.path.join(lovyan_dir, "src", "**", ext), recursive=True):
+            with open(path, encoding="utf-8", errors="ignore") as f:
+                text = f.read()
+            if re.search(r"\b" + FONT_SYMBOL + r"\s*\[", text):
+                data = parse_c_array(text, FONT_SYMBOL)
+                if data:
+                    return path, data
+    raise FileNotFoundError(f"{FONT_SYMBOL} not found in {lovyan_dir}")
+
+# ビット列の読み出し (U8g2と同じくLSBから)
+class BitReader:
+    def __init__(self, data, pos):
+        self.data = data
+        self.pos = pos
+        self.bit = 0
+
+    def unsigned(self, cnt):
+        val = self.data[self.pos] >> self.bit
+        bit = self.bit + cnt
+        if bit >= 8:
+            self.pos += 1
+            val |= self.data[self.pos] << (8 - self.bit)
+            bit -= 8
+        self.bit = bit
+        return val & ((1 << cnt) - 1)
+
+    def signed(self, cnt):
+        return self.unsigned(cnt) - (1 << (cnt - 1))
+
+# U8g2形式のフォント
+class U8g2Font:
+    def __init__(self, data):
+        self.data = data
+        (self.glyph_cnt, self.bbx_mode, self.bits_per_0, self.bits_per_1,
+         self.bits_per_w, self.bits_per_h, self.bits_per_x, self.bits_per_y,
+         self.bits_per_d) = data[0:9]
+        self.max_width  = data[9]
+        self.max_height = data[10]
+        self.x_offset   = to_int8(data[11])
+        self.y_offset   = to_int8(data[12])
+        self.start_unicode = (data[21] << 8) | data[22]
+
+    # 全グリフの位置 (文字コード → ビット列の先頭)
+    def glyph_positions(self):
+        positions = {}
+        # 8bitのグリフ
+        pos = 23
+        while self.data[pos + 1] != 0:
+            positions[self.data[pos]] = pos + 2
+            pos += self.data[pos + 1]
+        # 16bitのグリフ (先頭のルックアップテーブルを飛ばす)
+        pos = 23 + self.start_unicode
+        pos += (self.data[pos] << 8) | self.data[pos + 1]
+        while True:
+            code = (self.data[pos] << 8) | self.data[pos + 1]
+            if code == 0:
+                break
+            positions[code] = pos + 3
+            pos += self.data[pos + 2]
+        return positions
+
+    # グリフのデコード (幅, 高さ, X, Y, 送り幅, 各行のビット列)
+    def decode(self, pos):
+        r = BitReader(self.data, pos)
+        w = r.unsigned(self.bits_per_w)
+        h = r.unsigned(self.bits_per_h)
+        x = r.signed(self.bits_per_x)
+        y = r.signed(self.bits_per_y)
+        d = r.signed(self.bits_per_d)
+        pixels = []
+        if w > 0:
+            while True:
+                a = r.unsigned(self.bits_per_0)
+                b = r.unsigned(self.bits_per_1)
+                while True:
+                    pixels += [0] * a + [1] * b
+                    if r.unsigned(1) == 0:
+                        break
+                if len(pixels) >= w * h:
+                    break
+        rows = [pixels[i * w:(i + 1) * w] for i in range(h)] if w > 0 else []
+        return w, h, x, y, d, rows
+
+def to_int8(v):
+    return v - 256 if v >= 128 else v
+
+#######################################################
+#  ヘッダファイルの生成
+#######################################################
+
+def format_bytes(data, indent="  "):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append(indent + ", ".join("0x%02X" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+def generate_header(font, chars, config_hash):
+    positions = font.glyph_positions()
+    codes = sorted(ord(c) for c in chars if ord(c) in positions and ord(c) <= 0xFFFF)
+    missing = sorted(c for c in chars if ord(c) not in positions)
+    if missing:
+        print(f"gen_font_subset: {len(missing)} chars not in font: {''.join(missing[:40])}")
+
+    # グリフ (各行をバイト境界にそろえてMSBから詰める)
+    glyphs = []
+    bitmap = bytearray()
+    for code in codes:
+        w, h, x, y, d, rows = font.decode(positions[code])
+        glyphs.append((len(bitmap), w, h, x, y, d, code))
+        for row in rows:
+            row = row + [0] * (-len(row) % 8)
+            for i in range(0, len(row), 8):
+                v = 0
+                for bit in row[i:i + 8]:
+                    v = (v << 1) | bit
+                bitmap.append(v)
+
+    # 索引 (上位8bit → ページ, 下位8bit → ビットマップと累積数)
+    pages = sorted(set(code >> 8 for code in codes))
+    if len(pages) > 255:
+        raise ValueError("too many pages")
+    page_index = [0xFF] * 256
+    page_bits  = []
+    page_rank  = []
+    for n, page in enumerate(pages):
+        page_index[page] = n
+        bits = [0] * 8
+        for code in codes:
+            if code >> 8 == page:
+                bits[(code & 0xFF) >> 5] |= 1 << (code & 31)
+        base = bisect.bisect_left(codes, page << 8)
+        rank = []
+        for word in bits:
+            rank.append(base)
+            base += bin(word).count("1")
+        page_bits.append(bits)
+        page_rank.append(rank)
+
+    if not codes:
+        raise ValueError("gen_font_subset: no glyphs selected (none of the requested characters are in the font)")
+    if ord(FALLBACK_CHAR) not in codes:
+        raise ValueError(f"gen_font_subset: fallback glyph U+{ord(FALLBACK_CHAR):04X} is not in the font")
+    if len(bitmap) >= 1 << 24:
+        raise ValueError("gen_font_subset: bitmap too large for 24-bit glyph offsets")
+    check_code = ord("あ") if ord("あ") in codes else codes[len(codes) // 2]
+    ascent = font.max_height + font.y_offset
+
+    out = []
+    out.append("// このファイルは tools/gen_font_subset.py が生成する (編集しないこと)")
+    out.append(f"// config: {config_hash}")
+    out.append("#ifndef _FONT_SUBSET_DATA_H_")
+    out.append("#define _FONT_SUBSET_DATA_H_")
+    out.append("")
+    out.append("namespace font_subset {")
+    out.append("")
+    out.append(f"constexpr int GLYPH_COUNT = {len(codes)};")
+    out.append(f"constexpr int MAX_WIDTH   = {font.max_width};")
+    out.append(f"constexpr int HEIGHT      = {font.max_height};")
+    out.append(f"constexpr int ASCENT      = {ascent};")
+    out.append("")
+    out.append("// 索引の自己チェック用")
+    out.append(f"constexpr uint16_t CHECK_CODE  = 0x{check_code:04X};")
+    out.append(f"constexpr int      CHECK_INDEX = {codes.index(check_code)};")
+    out.append("")
+    out.append("// グリフ (offset, width, height, x, y, advance)")
+    out.append("constexpr Glyph GLYPHS[] = {")
+    for offset, w, h, x, y, d, code in glyphs:
+        out.append(f"  {{ {offset}, {w}, {h}, {x}, {y}, {d} }}, // U+{code:04X}")
+    out.append("};")
+    out.append("")
+    out.append("// 1bppのビットマップ (各行をバイト境界にそろえてMSBから)")
+    out.append("constexpr uint8_t BITMAP[] = {")
+    out.append(format_bytes(bitmap))
+    out.append("};")
+    out.append("")
+    out.append("// 上位8bit → ページ番号 (0xFFはグリフ無し)")
+    out.append("constexpr uint8_t PAGE_INDEX[256] = {")
+    out.append(format_bytes(page_index))
+    out.append("};")
+    out.append("")
+    out.append("// ページごとの下位8bitのビットマップ")
+    out.append("constexpr uint32_t PAGE_BITS[][8] = {")
+    for page, bits in zip(pages, page_bits):
+        out.append("  { " + ", ".join("0x%08X" % b for b in bits) + f" }}, // U+{page:02X}xx")
+    out.append("};")
+    out.append("")
+    out.append("// ページごと32bit単位の累積グリフ数")
+    out.append("constexpr uint16_t PAGE_RANK[][8] = {")
+    for rank in page_rank:
+        out.append("  { " + ", ".join(str(r) for r in rank) + " },")
+    out.append("};")
+    out.append("")
+    out.append("} // namespace font_subset")
+    out.append("")
+    out.append("#endif")
+    out.append("")
+    print(f"gen_font_subset: {len(codes)} glyphs, {len(bitmap)} bytes bitmap, {len(pages)} pages")
+    return "\n".join(out)
+
+# ベンチマーク用に元のフォントを書き出す
+def generate_stock_header(font_data):
+    out = []
+    out.append("// tools/gen_font_subset.py が生成する (ベンチマーク用の元のフォント)")
+    out.append("static const uint8_t STOCK_FONT[] = {")
+    out.append(format_bytes(font_data))
+    out.append("};")
+    out.append("")
+    return "\n".join(out)
+
+#######################################################
+#  実行
+#######################################################
+
+def config_hash(charset, extra, deck, font_path, font_data):
+    h = hashlib.sha1()
+    h.update(f"{GENERATOR_VERSION}\n{charset}\n{extra}\n{font_path}\n".encode("utf-8"))
+    h.update(font_data)
+    if deck:
+        with open(deck, "rb") as f:
+            h.update(f.read())
+    return h.hexdigest()
+
+def generate(project_dir, lovyan_dir, charset="jis1", deck=None, extra="", bench=False):
+    font_path, font_data = find_font_source(lovyan_dir)
+    chars = base_charset(charset) | set(extra)
+    if deck:
+        chars |= deck_chars(deck)
+    chars -= set("\r\n\t")
+    chars.add(FALLBACK_CHAR)
+
+    # 設定が変わっていなければ生成しない
+    output = os.path.join(project_dir, OUTPUT_PATH)
+    digest = config_hash(charset, extra, deck, os.path.basename(font_path), font_data)
+    if os.path.exists(output):
+        with open(output, encoding="utf-8") as f:
+            if f"// config: {digest}" in f.read(512):
+                print("gen_font_subset: up to date")
+                digest = None
+    if digest:
+        font = U8g2Font(font_data)
+        with open(output, "w", encoding="utf-8", newline="\n") as f:
+            f.write(generate_header(font, chars, digest))
+
+    if bench:
+        run_bench(project_dir, font_data)
+
+# 標準フォントとの比較ベンチマーク (ホストのC++コンパイラでビルドして実行)
+def run_bench(project_dir, font_data):
+    bench_dir = os.path.join(project_dir, BENCH_DIR)
+    os.makedirs(bench_dir, exist_ok=True)
+    with open(os.path.join(bench_dir, "stock_font_data.h"), "w", encoding="utf-8") as f:
+        f.write(generate_stock_header(font_data))
+    exe = os.path.join(bench_dir, "font_bench")
+    cxx = os.environ.get("CXX", "c++")
+    subprocess.check_call([cxx, "-O2", "-std=c++17",
+                           "-I", os.path.join(project_dir, "src"), "-I", bench_dir,
+                           os.path.join(project_dir, "tools", "font_bench.cpp"), "-o", exe])
+    subprocess.check_call([exe])
+
+# LovyanGFXのディレクトリを探す
+def find_lovyan(libdeps_dir):
+    for path in glob.glob(os.path.join(libdeps_dir, "*")):
+        if os.path.basename(path).lower().startswith("lovyangfx"):
+            return path
+    return None
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="generate subset font for the scouter")
+    parser.add_argument("--project", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+    parser.add_argument("--lovyan", required=True, help="LovyanGFXのディレクトリ")
+    parser.add_argument("--charset", default="jis1", choices=["jis1", "ascii"])
+    parser.add_argument("--deck", help="文字を追加するスライド資料 (.pptx またはテキスト)")
+    parser.add_argument("--extra", default="", help="追加する文字")
+    parser.add_argument("--bench", action="store_true", help="標準フォントとの比較ベンチマークを実行")
+    args = parser.parse_args(argv)
+    try:
+        generate(os.path.abspath(args.project), args.lovyan,
+                 args.charset, args.deck, args.extra, args.bench)
+    except (ValueError, FileNotFoundError) as e:
+        sys.stderr.write(f"{e}\n")
+        return 1
+    return 0
+
+# PlatformIOのビルド前スクリプトとして実行された場合
+def run_platformio(env):
+    # サブセットフォントを使わないビルドでは生成しない
+    flags = env.GetProjectOption("build_flags", "")
+    if isinstance(flags, (list, tuple)):
+        flags = " ".join(flags)
+    if "SCOUTER_SUBSET_FONT" not in flags + " " + os.environ.get("PLATFORMIO_BUILD_FLAGS", ""):
+        return
+
+    project_dir = env.subst("$PROJECT_DIR")
+    libdeps_dir = os.path.join(env.subst("$PROJECT_LIBDEPS_DIR"), env.subst("$PIOENV"))
+    lovyan_dir = find_lovyan(libdeps_dir)
+    if lovyan_dir is None:
+        # 初回はライブラリがまだ入っていないので先にインストールする
+        env.Execute("$PYTHONEXE -m platformio pkg install -d \"$PROJECT_DIR\" -e $PIOENV")
+        lovyan_dir = find_lovyan(libdeps_dir)
+    if lovyan_dir is None:
+        sys.stderr.write("gen_font_subset: LovyanGFX not found in %s\n" % libdeps_dir)
+        env.Exit(1)
+
+    deck = env.GetProjectOption("custom_font_deck", "")
+    if deck and not os.path.isabs(deck):
+        deck = os.path.join(project_dir, deck)
+    try:
+        generate(project_dir, lovyan_dir,
+                 env.GetProjectOption("custom_font_charset", "jis1"),
+                 deck or None,
+                 env.GetProjectOption("custom_font_extra", ""))
+    except (ValueError, FileNotFoundError) as e:
+        sys.stderr.write(f"{e}\n")
+        env.Exit(1)
+
+try:
+    Import("env") # PlatformIO (SCons) から実行された場合のみ定義されている
+except NameError:
+    env = None
+
+if env is not None:
+    run_platformio(env)
+elif __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,100 @@
+# USB CDC直結 (SerialTransport) の送信データの確認 (Linux用)
+#
+# pty をスカウターの代わりにして SerialTransport を開き、
+# 状態とバッテリー残量を送って読み戻したバイト列を確認する。
+# また、ptyのマスター側を閉じて (USBの抜去の代わり) 送信しなくても切断を検出できるか確認する。
+#   python check_serial_pty.py
+
+import os
+import sys
+import tty
+import struct
+import asyncio
+from   kanpe_transport import SerialTransport, to_scouter_frame, to_battery_frame
+
+# プレゼンターの send_to_scouter() と同じ書式でフレームを作る
+#   sprintf(tx_buff, "%c%X%04X%04X%s%c", 0x02, status, currentPage, totalPages, note, 0x03)
+def presenter_frame(status, current_page, total_pages, note):
+    text = "%c%X%04X%04X%s%c" % (0x02, status & 0x0F, current_page, total_pages, note, 0x03)
+    return text.encode("utf-8")
+
+# プレゼンターの send_battery_to_scouter() と同じ書式
+#   sprintf(tx_buff, "%c%%%02X%c", 0x02, level, 0x03)
+def presenter_battery_frame(level):
+    return ("%c%%%02X%c" % (0x02, level & 0xFF, 0x03)).encode("ascii")
+
+# ptyから指定バイト数を読む
+async def read_exact(fd, size, timeout=2.0):
+    data = b""
+    loop = asyncio.get_running_loop()
+    deadline = loop.time() + timeout
+    while len(data) < size and loop.time() < deadline:
+        try:
+            data += os.read(fd, size - len(data))
+        except BlockingIOError:
+            await asyncio.sleep(0.01)
+    return data
+
+# 送信が無い間にスカウターが抜かれたとき writer() が例外で終わるか
+async def detect_unplug():
+    master, slave = os.openpty()
+    transport = SerialTransport(os.ttyname(slave), lambda source, command: None)
+    await transport.connect()
+    writer = asyncio.create_task(transport.writer())
+    await asyncio.sleep(0.1)
+    os.close(master)
+    try:
+        await asyncio.wait_for(writer, timeout=3.0) # 1秒ごとの接続確認で検出されるはず
+        detected = False
+    except asyncio.TimeoutError:
+        # Python 3.11以降は OSError の派生なので先に捕まえる
+        detected = False
+    except OSError:
+        detected = True
+    await transport.close()
+    os.close(slave)
+    return detected, transport.write_count
+
+async def main():
+    master, slave = os.openpty()
+    tty.setraw(slave) # 改行コードを変換させない
+    os.set_blocking(master, False)
+
+    commands = []
+    transport = SerialTransport(os.ttyname(slave), lambda source, command: commands.append(command))
+    await transport.connect()
+    writer = asyncio.create_task(transport.writer())
+
+    note = "次のスライド\r\nデモ"
+    response = struct.pack("<BHH", 3, 12, 34) + note.encode("utf-8") + b"\0"
+    expected = to_scouter_frame(response) + to_battery_frame(85)
+    transport.post(response)
+    transport.post_battery(85)
+    received = await read_exact(master, len(expected))
+
+    await transport.close()
+    await writer
+    os.close(master)
+    os.close(slave)
+
+    detected, unplug_writes = await detect_unplug()
+
+    ok = True
+    def check(name, cond):
+        nonlocal ok
+        print(("OK   " if cond else "FAIL ") + name)
+        ok = ok and cond
+    check("status check requested on connect", commands == ["check"])
+    check("frames read back from pty", received == expected)
+    check("status frame matches presenter format",
+          to_scouter_frame(response) == presenter_frame(3, 12, 34, note))
+    check("battery frame matches presenter format",
+          to_battery_frame(85) == presenter_battery_frame(85))
+    check("unplug detected without a write", detected and unplug_writes == 0)
+    if not ok:
+        print("received:", received)
+        print("expected:", expected)
+    return 0 if ok else 1
+
+if __name__ == "__main__":
+    sys.exit(asyncio.run(main()))
@@ -3,19 +3,20 @@ import sys
 sys.coinit_flags = 0  # MTA (Multi Threaded Apartment) モードに設定
 
 import asyncio
-from   bleak import BleakClient, BleakError # BLEライブラリ
-import pythoncom # COMライブラリ
-import win32com.client
+from   bleak import BleakError # BLEライブラリ
+try:
+    import pythoncom # COMライブラリ
+    import win32com.client
+except ImportError:
+    pythoncom = None # COMが無い環境では --fake のみ使える
 import threading
+import time
 import struct
+import argparse
+from   kanpe_transport import CommandScheduler, BleTransport, SerialTransport, FakeTransport, discover_presenters
 
-# BLEデバイスのMACアドレス
-BLE_ADDRESS = "C7:66:0E:39:B6:29"
-
-# BLEのサービスとキャラクタリスティックUUID
-SVC_PPT_CTRL_UUID = "ba21ce66-9974-4ecd-b2e5-ab6d1497a7f0"
-CHR_COMMAND_UUID  = "ba21ce66-9974-4ecd-b2e5-ab6d1497a7f1"
-CHR_RESPONSE_UUID = "ba21ce66-9974-4ecd-b2e5-ab6d1497a7f2"
+# 同時に接続するプレゼンターの最大数
+MAX_PRESENTERS = 3
 
 # 真偽値の定義 (boolの代わりに明示的に整数を使用)
 TRUE  = 1
@@ -35,9 +36,18 @@ ppSlideShowBlackScreen  = 3 # スライドショーブラックアウト中
 ppSlideShowWhiteScreen  = 4 # スライドショーホワイトアウト中
 ppSlideShowDone         = 5 # スライドショー終了
 
-# コマンドとレスポンスのキュー (スレッド間通信)
-command_queue  = asyncio.Queue()
-response_queue = asyncio.Queue()
+# コマンドのスケジューラ (スレッド間通信)
+scheduler = CommandScheduler()
+
+# 接続中のトランスポート (名前 → トランスポート)
+transports = {}
+
+# プレゼンターのバッテリー残量[%] (名前 → 残量)
+battery_levels = {}
+
+# 応答データの生成回数と状態変化の回数 (計測用)
+encode_count = 0
+state_change_count = 0
 
 #######################################################
 #  COM動作スレッド側の関数群
@@ -105,25 +115,28 @@ def send_slideshow_status(ppt, pres, loop):
             note_bytes = note_text.encode('utf-8')[:299] + b'\0'  # NULL終端
             response = status + note_bytes
 
-    # BLEデバイスへの応答をキューに追加
-    asyncio.run_coroutine_threadsafe(
-        response_queue.put(response), loop
-    )
+    publish(response, loop)
+
+# 応答データを全デバイスに配る (応答データは1回だけ生成する)
+def publish(response, loop):
+    global encode_count
+    encode_count += 1
+    loop.call_soon_threadsafe(broadcast, response)
 
 # COM操作を行うスレッド
 def com_thread_runner(loop):
     pythoncom.CoInitialize() # COMライブラリの初期化
     try:
         while True:
-            if command_queue.empty():
-                # キューが空の場合はメッセージポンプを回す
+            # コマンドをスケジューラから取得 (最大0.1秒待つ)
+            item = scheduler.get(timeout=0.1)
+            if item is None:
+                # コマンドが無い場合はメッセージポンプを回す
                 pythoncom.PumpWaitingMessages()
-                asyncio.sleep(0.1)
                 continue
             else:
-                # コマンドをキューから取得
-                command = command_queue.get_nowait()
-                
+                source, command = item
+
                 # PowerPointアプリケーションとアクティブなプレゼンテーションを取得
                 ppt = get_ppt()
                 pres = get_active_presentation(ppt)
@@ -177,70 +190,166 @@ def com_thread_runner(loop):
                 # ステータスを送信
                 send_slideshow_status(ppt, pres, loop)
 
-            # if command_queue.empty() else ココマデ
+            # if item is None else ココマデ
         # while True ココマデ
     finally:
         pythoncom.CoUninitialize() # COMライブラリの終了
         print("COM thread shut down.")
 
+# COM操作を行うスレッドの代わり (計測用、PowerPointが無くても動く)
+#   デバイスの台数によらず、一定間隔でスライドを1枚ずつ進めた状態を配る
+def fake_com_thread_runner(loop, interval=0.5):
+    global state_change_count
+    current_page = 0
+    total_pages = 10
+    while True:
+        # デバイスからのコマンドは読み捨てる
+        while scheduler.get(timeout=0) is not None:
+            pass
+        time.sleep(interval)
+        current_page = current_page % total_pages + 1
+        state_change_count += 1
+        status = struct.pack("<BHH", PPT_RUNNING, current_page, total_pages)
+        note_bytes = f"fake note {current_page}".encode('utf-8') + b'\0'
+        publish(status + note_bytes, loop)
+
 #######################################################
 #  メインスレッド側の関数群
 #######################################################
 
-# コマンド受信時のコールバック
-def handle_notify(sender, data):
-    # コマンド文字列を取得
-    command = data.decode(errors="ignore").strip()
-    print(f"[Notify] {command}")
-    # コマンドをキューに追加
-    asyncio.run_coroutine_threadsafe(command_queue.put(command), asyncio.get_event_loop())
+# 応答データを接続中の全デバイスに配る
+def broadcast(response):
+    for transport in list(transports.values()):
+        transport.post(response)
 
-# BLEデバイスに接続してNotifyを待機、切断されたら再接続
+# プレゼンターのバッテリー残量を受信したとき
+#   直結したスカウターには接続中のプレゼンターで最も少ない残量を表示する
+def on_battery(name, level):
+    print(f"[Battery] {name}: {level}%")
+    battery_levels[name] = level
+    broadcast_battery()
+
+def broadcast_battery():
+    if not battery_levels:
+        return
+    level = min(battery_levels.values())
+    for transport in list(transports.values()):
+        transport.post_battery(level)
+
+# 1台のデバイスとの通信 (切断されるまで)
+async def serve(transport):
+    try:
+        await transport.connect()
+        print("Connected:", transport.name)
+        transports[transport.name] = transport
+        broadcast_battery()
+
+        # 接続が続く限り応答データを送信
+        await transport.writer()
+
+    except BleakError as e:
+        print(f"BLE Error ({transport.name}): {e}")
+    except asyncio.TimeoutError:
+        # Python 3.11以降は OSError の派生なので先に捕まえる
+        print(f"Connection timeout ({transport.name})")
+    except OSError as e: # serial.SerialException を含む
+        print(f"I/O Error ({transport.name}): {e}")
+
+    finally:
+        # 切断されたとき
+        transports.pop(transport.name, None)
+        if battery_levels.pop(transport.name, None) is not None:
+            broadcast_battery()
+        scheduler.remove(transport.name)
+        await transport.close()
+        print("Disconnected:", transport.name)
+
+# プレゼンターを探して接続、切断されたら再接続
 async def connect_and_listen():
+    connecting = set() # 接続処理中または接続中のアドレス
+
+    def on_done(address):
+        return lambda task: connecting.discard(address)
+
     while True:
+        # 接続数が上限に達していれば待機
+        if len(connecting) >= MAX_PRESENTERS:
+            await asyncio.sleep(1)
+            continue
         try:
-            # BLEデバイスに接続
-            print("Connecting...")
-            async with BleakClient(BLE_ADDRESS) as client:
-                print("Connected:", client.is_connected)
-                
-                # Notifyの開始
-                await client.start_notify(CHR_COMMAND_UUID, handle_notify)
-                print("Waiting for notify...")
-
-                # 接続が続く限り待機
-                while client.is_connected:
-                    try:
-                        # キューから応答データを取得
-                        response = await asyncio.wait_for(response_queue.get(), timeout=1.0)
-                        if response:
-                            # 応答データをBLEデバイスに送信
-                            await client.write_gatt_char(CHR_RESPONSE_UUID, response)
-                            # print(f"Main Loop: Wrote '{response}' to BLE.")
-                    except asyncio.TimeoutError:
-                        pass # キューが空でタイムアウトしたら待機を続ける
-                    except BleakError as e:
-                        print(f"Main Loop: BLE write error: {e}")
-                        break # BLEエラー時は再接続
-                
-                # 切断されたとき
-                await client.stop_notify(CHR_COMMAND_UUID)
-                print("Disconnected.")
-
-        # BLE接続エラー時(デバイスが見つからないなど)は少し待ってからリトライ
+            # サービスUUIDでプレゼンターを探す
+            print("Scanning...")
+            devices = await discover_presenters()
+        # BLEエラー時は少し待ってからリトライ
         except BleakError as e:
-            print(f"Connection Error: {e}")
+            print(f"Scan Error: {e}")
             await asyncio.sleep(1)
+            continue
+
+        for device in devices:
+            if device.address in connecting or len(connecting) >= MAX_PRESENTERS:
+                continue
+            # 新しいプレゼンターに接続 (デバイスごとに並行して動作)
+            print("Connecting:", device.address)
+            connecting.add(device.address)
+            transport = BleTransport(device, scheduler.put, on_battery)
+            task = asyncio.create_task(serve(transport))
+            task.add_done_callback(on_done(device.address))
+
+        await asyncio.sleep(1)
+
+# USB CDCで直結したスカウターに接続、切断されたら再接続
+async def connect_serial(port):
+    while True:
+        await serve(SerialTransport(port, scheduler.put))
+        await asyncio.sleep(1)
+
+# 偽のデバイスで動作させる (台数を増やしてもCOMの処理が増えないことの確認用)
+#   状態変化1回につき応答データの生成1回、送信はデバイスの台数分になる
+async def run_fake(count):
+    for i in range(count):
+        asyncio.create_task(serve(FakeTransport(f"fake{i}")))
+
+    # 統計情報を定期的に表示
+    while True:
+        await asyncio.sleep(5)
+        writes = sum(t.write_count for t in transports.values())
+        changes = max(state_change_count, 1)
+        print(f"Stats: devices={len(transports)} state_changes={state_change_count} "
+              f"encodes={encode_count} ({encode_count / changes:.2f}/change) "
+              f"writes={writes} ({writes / changes:.2f}/change)")
 
 # メイン関数
-async def main():
+async def main(args):
     # イベントループを取得
     loop = asyncio.get_running_loop()
     # COMスレッドを起動 (イベントループを引数に渡す)
-    com_thread = threading.Thread(target=com_thread_runner, daemon=True, args=(loop,))
+    if args.fake > 0:
+        runner = fake_com_thread_runner # PowerPointの代わり
+    elif pythoncom is None:
+        print("pywin32 is not available (only --fake can be used)")
+        return
+    else:
+        runner = com_thread_runner
+    if args.serial and not SerialTransport.available():
+        print("pyserial is not available (--serial cannot be used)")
+        return
+    com_thread = threading.Thread(target=runner, daemon=True, args=(loop,))
     com_thread.start()
-    # BLE接続とNotify待機
-    await connect_and_listen()
+    # USB CDCで直結したスカウター
+    for port in args.serial:
+        asyncio.create_task(connect_serial(port))
+    if args.fake > 0:
+        # 偽のデバイスで動作
+        await run_fake(args.fake)
+    else:
+        # BLE接続とNotify待機
+        await connect_and_listen()
 
 if __name__ == "__main__":
-    asyncio.run(main())
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--fake", type=int, default=0,
+                        help="BLEの代わりに指定台数の偽デバイスを使う (計測用)")
+    parser.add_argument("--serial", action="append", default=[], metavar="PORT",
+                        help="USB CDCで直結したスカウターのシリアルポート (複数指定可)")
+    asyncio.run(main(parser.parse_args()))
@@ -0,0 +1,254 @@
+# カンペスカウターの通信路 (トランスポート) とコマンドのスケジューラ
+#
+# COMに依存しないのでWindows以外でも import できる
+
+import asyncio
+import threading
+import collections
+import struct
+try:
+    import serial # シリアルポートライブラリ (pyserial)
+except ImportError:
+    serial = None # pyserial が無い環境では SerialTransport は使えない
+from   bleak import BleakClient, BleakScanner, BleakError # BLEライブラリ
+
+# BLEのサービスとキャラクタリスティックUUID
+SVC_PPT_CTRL_UUID = "ba21ce66-9974-4ecd-b2e5-ab6d1497a7f0"
+CHR_COMMAND_UUID  = "ba21ce66-9974-4ecd-b2e5-ab6d1497a7f1"
+CHR_RESPONSE_UUID = "ba21ce66-9974-4ecd-b2e5-ab6d1497a7f2"
+CHR_BATTERY_UUID  = "ba21ce66-9974-4ecd-b2e5-ab6d1497a7f3"
+
+#######################################################
+#  コマンドのスケジューラ (複数プレゼンター → COMスレッド)
+#######################################################
+
+# 送信元ごとにコマンドを溜めて、ラウンドロビンで1つずつ取り出す
+# (1台のプレゼンターが連打しても他のプレゼンターのコマンドが待たされない)
+class CommandScheduler:
+    def __init__(self):
+        self._cond   = threading.Condition()
+        self._queues = collections.OrderedDict() # 送信元 → コマンドのキュー
+
+    # コマンドを追加 (どのスレッドから呼んでもよい)
+    def put(self, source, command):
+        with self._cond:
+            if source not in self._queues:
+                self._queues[source] = collections.deque()
+            self._queues[source].append(command)
+            self._cond.notify()
+
+    # コマンドを取り出す (なければtimeout秒待ってNoneを返す)
+    def get(self, timeout=None):
+        with self._cond:
+            if not self._has_command():
+                self._cond.wait(timeout)
+            for source, queue in self._queues.items():
+                if queue:
+                    command = queue.popleft()
+                    # 取り出した送信元を末尾に回す
+                    self._queues.move_to_end(source)
+                    return source, command
+            return None
+
+    # 切断された送信元のコマンドを破棄
+    def remove(self, source):
+        with self._cond:
+            self._queues.pop(source, None)
+
+    def _has_command(self):
+        return any(self._queues.values())
+
+#######################################################
+#  トランスポート
+#######################################################
+
+# トランスポートの基底クラス
+#   種類ごとに post() された最新のデータだけを送る (送信が詰まっている間の古いデータは捨てる)
+class Transport:
+    def __init__(self, name):
+        self.name = name
+        self.write_count = 0 # 送信回数 (計測用)
+        self._pending = {}   # 種類 → 送信データ
+        self._event   = asyncio.Event()
+
+    # 応答データを送信予約 (イベントループ上で呼ぶ)
+    def post(self, response):
+        self._post("status", response)
+
+    # バッテリー残量[%]を送信予約 (必要なトランスポートだけ実装する)
+    def post_battery(self, level):
+        pass
+
+    def _post(self, kind, data):
+        self._pending[kind] = data
+        self._event.set()
+
+    # 送信予約された応答データを順次送信する
+    async def writer(self):
+        while self.is_connected():
+            try:
+                await asyncio.wait_for(self._event.wait(), timeout=1.0)
+            except asyncio.TimeoutError:
+                # 接続状態の確認のため定期的に抜ける
+                await self.probe()
+                continue
+            self._event.clear()
+            pending, self._pending = self._pending, {}
+            for data in pending.values():
+                await self.write(data)
+                self.write_count += 1
+
+    def is_connected(self):
+        raise NotImplementedError
+
+    # 送信していない間の接続確認 (切断を検出したら例外を投げる)
+    async def probe(self):
+        pass
+
+    async def write(self, data):
+        raise NotImplementedError
+
+# BLE接続のプレゼンター
+#   プレゼンターのバッテリー残量は on_battery(名前, 残量[%]) で通知する
+class BleTransport(Transport):
+    def __init__(self, device, on_command, on_battery):
+        super().__init__(device.address)
+        self._client = BleakClient(device, disconnected_callback=self._on_disconnect)
+        self._on_command = on_command
+        self._on_battery = on_battery
+        self._connected = False
+
+    # 接続してNotifyを開始
+    async def connect(self):
+        await self._client.connect()
+        self._connected = True
+        await self._client.start_notify(CHR_COMMAND_UUID, self._handle_notify)
+
+        # バッテリー残量 (古いファームウェアには無い)
+        try:
+            level = await self._client.read_gatt_char(CHR_BATTERY_UUID)
+            self._handle_battery(None, level)
+            await self._client.start_notify(CHR_BATTERY_UUID, self._handle_battery)
+        except BleakError as e:
+            print(f"Battery level not available ({self.name}): {e}")
+
+    # 切断
+    async def close(self):
+        self._connected = False
+        try:
+            await self._client.disconnect()
+        except BleakError:
+            pass
+
+    def is_connected(self):
+        return self._connected and self._client.is_connected
+
+    async def write(self, data):
+        await self._client.write_gatt_char(CHR_RESPONSE_UUID, data)
+
+    # コマンド受信時のコールバック
+    def _handle_notify(self, sender, data):
+        command = data.decode(errors="ignore").strip()
+        print(f"[Notify] {self.name}: {command}")
+        self._on_command(self.name, command)
+
+    # バッテリー残量の受信時のコールバック
+    def _handle_battery(self, sender, data):
+        if len(data) >= 1:
+            self._on_battery(self.name, data[0])
+
+    def _on_disconnect(self, client):
+        self._connected = False
+
+# スカウターへのフレームを生成 (プレゼンターの send_to_scouter() と同じ形式)
+#   STX, 状態(1桁), 現在のスライド番号(4桁), 総スライド数(4桁), ノート, ETX
+def to_scouter_frame(response):
+    status, current_page, total_pages = struct.unpack_from("<BHH", response)
+    note_bytes = response[5:].split(b"\0", 1)[0]
+    header = "%X%04X%04X" % (status & 0x0F, current_page, total_pages)
+    return b"\x02" + header.encode("ascii") + note_bytes + b"\x03"
+
+# スカウターへのバッテリー残量のフレームを生成
+#   STX, '%', 残量[%](2桁), ETX
+def to_battery_frame(level):
+    return b"\x02" + ("%%%02X" % (level & 0xFF)).encode("ascii") + b"\x03"
+
+# USB CDCで直結したスカウター (プレゼンターを経由しない)
+#   Linuxでは pty をスカウターの代わりにして試験できる
+class SerialTransport(Transport):
+    def __init__(self, port, on_command):
+        super().__init__(port)
+        self._port_name = port
+        self._port = None
+        self._on_command = on_command
+
+    # pyserial が使えるか
+    @staticmethod
+    def available():
+        return serial is not None
+
+    # ポートを開いて現在の状態を要求
+    async def connect(self):
+        # USB CDCではボーレートは無視される
+        self._port = serial.Serial(self._port_name, 115200, timeout=0, write_timeout=1.0)
+        self._on_command(self.name, "check")
+
+    # ポートを閉じる
+    async def close(self):
+        if self._port is not None:
+            self._port.close()
+
+    def is_connected(self):
+        return self._port is not None and self._port.is_open
+
+    # is_open はポートを閉じるまでTrueのままなので、読み出しでUSBの抜去を検出する
+    #   (切断されたハンドルでは例外になる。スカウターのデバッグ出力は読み捨てる)
+    async def probe(self):
+        if not self.is_connected():
+            return # close() 済み
+        self._port.read(max(self._port.in_waiting, 1))
+
+    # スカウター向けのフレームに変換して送信予約
+    def post(self, response):
+        self._post("status", to_scouter_frame(response))
+
+    def post_battery(self, level):
+        self._post("battery", to_battery_frame(level))
+
+    async def write(self, frame):
+        loop = asyncio.get_running_loop()
+        await loop.run_in_executor(None, self._send, frame)
+
+    def _send(self, frame):
+        # スカウターのデバッグ出力は読み捨てる
+        self._port.reset_input_buffer()
+        self._port.write(frame)
+        self._port.flush()
+
+# 計測用の偽トランスポート
+#   送信は待ち時間だけ模擬する
+class FakeTransport(Transport):
+    def __init__(self, name, latency=0.02):
+        super().__init__(name)
+        self._latency = latency
+
+    async def connect(self):
+        pass
+
+    async def close(self):
+        pass
+
+    def is_connected(self):
+        return True
+
+    async def write(self, data):
+        await asyncio.sleep(self._latency)
+
+#######################################################
+#  BLEデバイスの探索
+#######################################################
+
+# サービスUUIDでプレゼンターを探す
+async def discover_presenters(timeout=5.0):
+    devices = await BleakScanner.discover(timeout=timeout, service_uuids=[SVC_PPT_CTRL_UUID])
+    return devices